@@ -9,6 +9,14 @@
  * The arena will use whichever one was defined, but will prefer a
  * reserve/commit strategy when both are defined. If none are defined, the arena
  * will use malloc and free by default.
+ *
+ * For NUMA placement additionally define MEM_ARENA_OS_RESERVE_NUMA(size, node),
+ * MEM_ARENA_OS_NUMA_NODE_COUNT(), MEM_ARENA_OS_NUMA_NODE_ONLINE(node) and
+ * MEM_ARENA_OS_NUMA_CURRENT_NODE(), e.g. with mem_reserve_numa(NULL, size, node),
+ * mem_numa_node_count(), mem_numa_node_online(node) and mem_numa_current_node()
+ * from memory.h. Without them every arena lives on "node 0" and the per-node
+ * helpers just hand out a single arena. Only mem_arena_create_on_node() and the
+ * per-node helpers use MEM_ARENA_OS_RESERVE_NUMA, mem_arena_create() doesn't.
  */
 
 /* NOTE: used when arena is supposed to just alloc and free (not reserve & commit) */
@@ -46,27 +54,55 @@
   #define MEM_ARENA_USE_RESERVE_AND_COMMIT_STRATEGY
 #endif
 
+#ifndef MEM_ARENA_OS_NUMA_NODE_COUNT
+  #define MEM_ARENA_OS_NUMA_NODE_COUNT()       1
+#endif
+#ifndef MEM_ARENA_OS_NUMA_NODE_ONLINE
+  #define MEM_ARENA_OS_NUMA_NODE_ONLINE(node)  1
+#endif
+#ifndef MEM_ARENA_OS_NUMA_CURRENT_NODE
+  #define MEM_ARENA_OS_NUMA_CURRENT_NODE()     0
+#endif
+#define MEM_ARENA_NUMA_MAX_NODES 64
+#define MEM_ARENA_NUMA_ANY        (-2) /* same value as MEM_NUMA_ANY in memory.h */
+#define MEM_ARENA_NUMA_INTERLEAVE (-1) /* same value as MEM_NUMA_INTERLEAVE in memory.h */
+
 struct mem_arena_t;
 typedef struct mem_arena_t mem_arena_t;
 
 /* api */
-mem_arena_t* mem_arena_create  (size_t        size_in_bytes);
-void*        mem_arena_push    (mem_arena_t*  arena, size_t size); /* push onto arena, committing if needed  */
+mem_arena_t* mem_arena_create        (size_t        size_in_bytes);
+mem_arena_t* mem_arena_create_on_node(size_t        size_in_bytes, int node); /* node index (preferred, not strict) or MEM_ARENA_NUMA_INTERLEAVE */
+void*        mem_arena_push          (mem_arena_t*  arena, size_t size); /* push onto arena, committing if needed  */
 
-void*        mem_arena_place   (mem_arena_t*  arena, size_t size); /* push onto arena w/o committing memory  */
-mem_arena_t* mem_arena_subarena(mem_arena_t*  base,  size_t size); /* pushes on an arena w/o committing memory */
+void*        mem_arena_place         (mem_arena_t*  arena, size_t size); /* push onto arena w/o committing memory  */
+mem_arena_t* mem_arena_subarena      (mem_arena_t*  base,  size_t size); /* pushes on an arena w/o committing memory */
 
-void         mem_arena_pop_to  (mem_arena_t*  arena, char* buf);
-void         mem_arena_pop_by  (mem_arena_t*  arena, size_t bytes);
+void         mem_arena_pop_to        (mem_arena_t*  arena, char* buf);
+void         mem_arena_pop_by        (mem_arena_t*  arena, size_t bytes);
 
-void         mem_arena_clear   (mem_arena_t*  arena);
-void         mem_arena_destroy (mem_arena_t** arena);
+void         mem_arena_clear         (mem_arena_t*  arena);
+void         mem_arena_destroy       (mem_arena_t** arena);
 
 /* helper */
-mem_arena_t* mem_arena_default ();
+mem_arena_t* mem_arena_default       ();
 #define ARENA_PUSH_ARRAY(arena, type, count) (type*) mem_arena_push((arena), sizeof(type)*(count))
 #define ARENA_PUSH_STRUCT(arena, type)       ARENA_PUSH_ARRAY((arena), type, 1)
 
+/* one arena per NUMA node, threads should push onto the one local to them.
+ * arenas[] is indexed by node id, nodes that aren't online (or have no memory)
+ * stay NULL; threads running on such a node get the arena with the closest id.
+ * NOTE: mem_arena_numa_local() asks the OS for the current node on every call,
+ * look it up once per thread and keep the arena instead of calling it per push */
+typedef struct mem_arena_numa_set_t
+{
+    int          count;
+    mem_arena_t* arenas[MEM_ARENA_NUMA_MAX_NODES];
+} mem_arena_numa_set_t;
+mem_arena_numa_set_t mem_arena_numa_create (size_t size_per_node);
+mem_arena_t*         mem_arena_numa_local  (mem_arena_numa_set_t* set); /* arena of the calling thread's node */
+void                 mem_arena_numa_destroy(mem_arena_numa_set_t* set);
+
 //#define ARENA_BUFFER(arena, pos)             ((void*) ((((char*) arena) + sizeof(mem_arena_t)) + pos))
 
 /* TODO scratch arenas */
@@ -91,14 +127,26 @@ struct mem_arena_t
 };
 
 mem_arena_t* mem_arena_create(size_t size_in_bytes) {
+    return mem_arena_create_on_node(size_in_bytes, MEM_ARENA_NUMA_ANY);
+}
+mem_arena_t* mem_arena_create_on_node(size_t size_in_bytes, int node) {
 
     #ifdef MEM_ARENA_USE_RESERVE_AND_COMMIT_STRATEGY
-      mem_arena_t* arena = (mem_arena_t*) MEM_ARENA_OS_RESERVE(size_in_bytes + sizeof(mem_arena_t));
+      #ifdef MEM_ARENA_OS_RESERVE_NUMA
+        /* NOTE: plain arenas must not get a placement policy */
+        mem_arena_t* arena = (node == MEM_ARENA_NUMA_ANY)
+                           ? (mem_arena_t*) MEM_ARENA_OS_RESERVE(size_in_bytes + sizeof(mem_arena_t))
+                           : (mem_arena_t*) MEM_ARENA_OS_RESERVE_NUMA(size_in_bytes + sizeof(mem_arena_t), node);
+      #else
+        mem_arena_t* arena = (mem_arena_t*) MEM_ARENA_OS_RESERVE(size_in_bytes + sizeof(mem_arena_t));
+        (void) node;
+      #endif
 
       /* commit enough to write the arena metadata */
       MEM_ARENA_OS_COMMIT((void*) arena, sizeof(mem_arena_t));
     #else
       mem_arena_t* arena = (mem_arena_t*) MEM_ARENA_OS_ALLOC(size_in_bytes + sizeof(mem_arena_t));
+      (void) node; /* NOTE: malloc'ed memory ends up wherever it is first touched */
     #endif
 
     MEM_ARENA_ASSERT(arena);
@@ -218,4 +266,38 @@ mem_arena_t* mem_arena_default() {
     mem_arena_t* default_arena = mem_arena_create(ARENA_DEFAULT_RESERVE_SIZE);
     return default_arena;
 }
+
+mem_arena_numa_set_t mem_arena_numa_create(size_t size_per_node) {
+    mem_arena_numa_set_t set;
+    memset(&set, 0, sizeof(set));
+    set.count = MEM_ARENA_OS_NUMA_NODE_COUNT();
+    if (set.count < 1)                        { set.count = 1; }
+    if (set.count > MEM_ARENA_NUMA_MAX_NODES) { set.count = MEM_ARENA_NUMA_MAX_NODES; }
+
+    for (int node = 0; node < set.count; node++) {
+        if (!MEM_ARENA_OS_NUMA_NODE_ONLINE(node)) { continue; } /* node ids can have holes */
+        set.arenas[node] = mem_arena_create_on_node(size_per_node, node);
+    }
+    return set;
+}
+mem_arena_t* mem_arena_numa_local(mem_arena_numa_set_t* set) {
+    int node = MEM_ARENA_OS_NUMA_CURRENT_NODE();
+    if (node >= 0 && node < set->count && set->arenas[node]) { return set->arenas[node]; }
+
+    /* no arena for this node (e.g. a cpu-only node), take the one with the
+     * closest node id as a cheap stand-in for the actual node distance */
+    if (node < 0)           { node = 0; }
+    if (node >= set->count) { node = set->count - 1; }
+    for (int offset = 0; offset < set->count; offset++) {
+        if (node - offset >= 0         && set->arenas[node - offset]) { return set->arenas[node - offset]; }
+        if (node + offset < set->count && set->arenas[node + offset]) { return set->arenas[node + offset]; }
+    }
+    return NULL;
+}
+void mem_arena_numa_destroy(mem_arena_numa_set_t* set) {
+    for (int node = 0; node < set->count; node++) {
+        if (set->arenas[node]) { mem_arena_destroy(&set->arenas[node]); }
+    }
+    set->count = 0;
+}
 #endif // MEM_ARENA_IMPLEMENTATION
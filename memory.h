@@ -1,5 +1,11 @@
 #pragma once
 
+/* NOTE: mmap flags (MAP_ANONYMOUS), syscall() and getcpu() are hidden by glibc
+ * under a strict -std=c99/c11, has to come before the first system include */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+  #define _GNU_SOURCE
+#endif
+
 #ifndef MEM_ASSERT
     #include <assert.h>
     #define MEM_ASSERT(expr) assert(expr)
@@ -20,6 +26,28 @@ int    mem_equal   (void* buf_a, void* buf_b, size_t size_in_bytes);
 void   mem_copy    (void* dst,   void* src,   size_t size_in_bytes);
 size_t mem_pagesize(); /* pagesize in bytes */
 
+/* NUMA placement: node is a node index, MEM_NUMA_ANY or MEM_NUMA_INTERLEAVE.
+ * Placement is best effort: a node index only sets the *preferred* node
+ * (MPOL_PREFERRED on linux), pages spill over to other nodes once it is full
+ * instead of triggering the OOM killer. mem_{reserve,commit}_numa still hand
+ * out memory when it can't be bound, mem_numa_bind() returns 0 on bad nodes or
+ * failure and 1 when the range is bound or there is nothing to do (MEM_NUMA_ANY).
+ * Only nodes with memory count as online, cpu-only nodes can't be bound to.
+ * Windows: the node only takes effect through mem_reserve_numa (when the region
+ * is created), mem_commit_numa/mem_numa_bind can't move an existing reservation
+ * and a range can't be interleaved, it gets default placement instead.
+ * NOTE: the node layout is cached on the first call to any of these, make that
+ * first call before spawning threads (mem_arena_numa_create() does this). */
+#define MEM_NUMA_ANY         (-2)  /* no preference, i.e. plain mem_reserve/mem_commit */
+#define MEM_NUMA_INTERLEAVE  (-1)  /* spread pages round-robin over all nodes */
+#define MEM_NUMA_MAX_NODES    64
+void*  mem_reserve_numa     (void* at,  size_t size, int node);
+int    mem_commit_numa      (void* ptr, size_t size, int node);
+int    mem_numa_bind        (void* ptr, size_t size, int node); /* set policy of a reserved range */
+int    mem_numa_node_count  (); /* highest node index + 1, at least 1 */
+int    mem_numa_node_online (int node); /* has memory, node ids can be sparse, e.g. "0,2" */
+int    mem_numa_current_node(); /* node of the cpu the calling thread runs on */
+
 /* helper macros */
 #define MEM_ZERO_OUT_STRUCT(s) mem_zero_out((s), sizeof(*(s)))
 #define MEM_ZERO_OUT_ARRAY(a)  MEM_ASSERT(IS_ARRAY(a)); mem_zero_out((a), sizeof(a))
@@ -81,6 +109,41 @@ size_t  mem_pagesize() {
     GetSystemInfo(&si);
     return si.dwPageSize;
 }
+void* mem_reserve_numa(void* at, size_t size, int node) {
+    if (node < 0 || mem_numa_node_count() <= 1 || !mem_numa_node_online(node)) { return mem_reserve(at, size); }
+    return VirtualAllocExNuma(GetCurrentProcess(), at, size, MEM_RESERVE, PAGE_READWRITE, (DWORD) node);
+}
+int mem_commit_numa(void* ptr, size_t size, int node) {
+    (void) node; /* NOTE: the preferred node is ignored when committing inside an existing reservation */
+    return mem_commit(ptr, size);
+}
+int mem_numa_bind(void* ptr, size_t size, int node) {
+    (void) ptr; (void) size;
+    if (node == MEM_NUMA_ANY)                            { return 1; }
+    if (node < 0 && node != MEM_NUMA_INTERLEAVE)         { return 0; }
+    if (node >= 0 && !mem_numa_node_online(node))        { return 0; }
+    if (node == MEM_NUMA_INTERLEAVE || mem_numa_node_count() <= 1) { return 1; } /* default placement */
+    return 0; /* can't rebind a reservation after the fact, use mem_{reserve,commit}_numa */
+}
+int mem_numa_node_count() {
+    ULONG highest = 0;
+    if (!GetNumaHighestNodeNumber(&highest)) { return 1; }
+    return (highest + 1 > MEM_NUMA_MAX_NODES) ? MEM_NUMA_MAX_NODES : (int) highest + 1;
+}
+int mem_numa_node_online(int node) {
+    ULONGLONG available = 0;
+    if (node < 0 || node >= mem_numa_node_count()) { return 0; }
+    if (mem_numa_node_count() == 1)                { return 1; }
+    return GetNumaAvailableMemoryNode((UCHAR) node, &available) != 0;
+}
+int mem_numa_current_node() {
+    /* NOTE: processor numbers are per processor group (> 64 cpus), so use the Ex versions */
+    PROCESSOR_NUMBER processor;
+    USHORT           node = 0;
+    GetCurrentProcessorNumberEx(&processor);
+    if (!GetNumaProcessorNodeEx(&processor, &node) || node == 0xFFFF) { return 0; }
+    return (node >= MEM_NUMA_MAX_NODES) ? 0 : node;
+}
 
 #elif defined(__linux__)
 
@@ -154,5 +217,116 @@ void mem_copy(void* dst, void* src, size_t size_in_bytes) {
 size_t  mem_pagesize() {
     return sysconf(_SC_PAGE_SIZE);
 }
+
+/*
+ * NOTE: we issue the mbind syscall directly so we don't depend on libnuma
+ * (numaif.h). The memory policy is attached to the mapping, so pages that get
+ * committed later are still placed on the preferred node on first touch.
+ */
+#include <fcntl.h>       /* for open */
+#include <sched.h>       /* for getcpu */
+#include <sys/syscall.h> /* for SYS_mbind, SYS_getcpu */
+#define MEM_MPOL_PREFERRED  1 /* same values as MPOL_* in linux/mempolicy.h */
+#define MEM_MPOL_INTERLEAVE 3
+#define MEM_NUMA_MASK_BITS  (8 * sizeof(unsigned long))
+void* mem_reserve_numa(void* at, size_t size, int node) {
+    void* mem = mem_reserve(at, size);
+    if (mem) { mem_numa_bind(mem, size, node); } /* placement is only a hint, ignore failure */
+    return mem;
+}
+int mem_commit_numa(void* ptr, size_t size, int node) {
+    mem_numa_bind(ptr, size, node);
+    return mem_commit(ptr, size);
+}
+int mem_numa_bind(void* ptr, size_t size, int node) {
+    if (node == MEM_NUMA_ANY)                                    { return 1; } /* no policy */
+    if (node <  0 && node != MEM_NUMA_INTERLEAVE)                { return 0; }
+    if (node >= 0 && !mem_numa_node_online(node))                { return 0; }
+
+    unsigned long nodemask[MEM_NUMA_MAX_NODES / MEM_NUMA_MASK_BITS] = {0};
+    int mode = MEM_MPOL_PREFERRED; /* not MPOL_BIND, that one OOMs instead of spilling over */
+    if (node == MEM_NUMA_INTERLEAVE) {
+        mode = MEM_MPOL_INTERLEAVE;
+        for (int i = 0; i < mem_numa_node_count(); i++) {
+            if (mem_numa_node_online(i)) { nodemask[i / MEM_NUMA_MASK_BITS] |= 1UL << (i % MEM_NUMA_MASK_BITS); }
+        }
+    } else {
+        nodemask[node / MEM_NUMA_MASK_BITS] |= 1UL << (node % MEM_NUMA_MASK_BITS);
+    }
+
+    /* mbind wants a page aligned start address */
+    uintptr_t bind_begin = ALIGN_TO_PREV_PAGE(ptr);
+    uintptr_t bind_end   = ALIGN_TO_NEXT_PAGE((uintptr_t) ptr + size);
+
+    #ifdef SYS_mbind
+      /* NOTE: the kernel drops the last bit of maxnode, hence the + 1 (libnuma does the same) */
+      long result = syscall(SYS_mbind, bind_begin, bind_end - bind_begin, mode, nodemask, MEM_NUMA_MAX_NODES + 1, 0);
+      return (result == 0);
+    #else
+      return 0;
+    #endif
+}
+static int           mem_numa_count = 0; /* 0 means not read yet */
+static unsigned long mem_numa_online_mask[MEM_NUMA_MAX_NODES / MEM_NUMA_MASK_BITS];
+/* parses a sysfs node list like "0" or "0-1" or "0,2-3" into mask, returns highest node or -1 */
+static int mem_numa_read_node_list(const char* path, unsigned long* mask) {
+    char buf[256];
+    int  highest = -1;
+    int  fd      = open(path, O_RDONLY);
+    ssize_t len  = (fd >= 0) ? read(fd, buf, sizeof(buf) - 1) : -1;
+    if (fd >= 0) { close(fd); }
+    if (len <= 0) { return -1; }
+
+    int value = 0, range_begin = -1;
+    for (ssize_t i = 0; i <= len; i++) {
+        char c = (i < len) ? buf[i] : ',';
+        if (c >= '0' && c <= '9') { value = value * 10 + (c - '0'); continue; }
+        if (c == '-')             { range_begin = value; value = 0; continue; }
+
+        /* end of an entry, mark [range_begin, value] */
+        int begin = (range_begin < 0) ? value : range_begin;
+        for (int node = begin; node <= value && node < MEM_NUMA_MAX_NODES; node++) {
+            mask[node / MEM_NUMA_MASK_BITS] |= 1UL << (node % MEM_NUMA_MASK_BITS);
+            if (node > highest) { highest = node; }
+        }
+        value       = 0;
+        range_begin = -1;
+        if (c == '\n' || c == '\0') { break; }
+    }
+    return highest;
+}
+static void mem_numa_read_nodes() {
+    /* nodes w/o memory (cpu-only) are online too, but can't be bound to */
+    unsigned long cpu_mask[MEM_NUMA_MAX_NODES / MEM_NUMA_MASK_BITS] = {0};
+    int highest_online = mem_numa_read_node_list("/sys/devices/system/node/online",     cpu_mask);
+    int highest_memory = mem_numa_read_node_list("/sys/devices/system/node/has_memory", mem_numa_online_mask);
+    if (highest_memory < 0) { /* older kernels */
+        highest_memory = highest_online;
+        mem_copy(mem_numa_online_mask, cpu_mask, sizeof(cpu_mask));
+    }
+    if (highest_memory < 0) { /* no sysfs, assume a single node */
+        mem_numa_online_mask[0] = 1;
+        highest_memory          = 0;
+    }
+    mem_numa_count = ((highest_online > highest_memory) ? highest_online : highest_memory) + 1;
+}
+int mem_numa_node_count() {
+    if (!mem_numa_count) { mem_numa_read_nodes(); }
+    return mem_numa_count;
+}
+int mem_numa_node_online(int node) {
+    if (node < 0 || node >= mem_numa_node_count()) { return 0; }
+    return (mem_numa_online_mask[node / MEM_NUMA_MASK_BITS] >> (node % MEM_NUMA_MASK_BITS)) & 1;
+}
+int mem_numa_current_node() {
+    unsigned int cpu  = 0;
+    unsigned int node = 0;
+    #if defined(__GLIBC__) && defined(__USE_GNU) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 29)
+      if (getcpu(&cpu, &node) != 0) { return 0; } /* goes through the vDSO, no kernel entry */
+    #elif defined(SYS_getcpu)
+      if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) { return 0; }
+    #endif
+    return ((int) node < mem_numa_node_count()) ? (int) node : 0;
+}
 #endif
 #endif // MEMORY_IMPLEMENTATION
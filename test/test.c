@@ -23,6 +23,10 @@
 #define MEM_ARENA_OS_COMMIT(ptr,size)   mem_commit(ptr, size)
 #define MEM_ARENA_OS_RELEASE(ptr,size)  mem_release(ptr, size)
 #define MEM_ARENA_OS_DECOMMIT(ptr,size) mem_decommit(ptr, size)
+#define MEM_ARENA_OS_RESERVE_NUMA(size,node)  mem_reserve_numa(NULL, size, node)
+#define MEM_ARENA_OS_NUMA_NODE_COUNT()        mem_numa_node_count()
+#define MEM_ARENA_OS_NUMA_NODE_ONLINE(node)   mem_numa_node_online(node)
+#define MEM_ARENA_OS_NUMA_CURRENT_NODE()      mem_numa_current_node()
 #include "../mem_arena.h"
 
 #define KILOBYTES(val) (         (val) * 1024LL)
@@ -149,6 +153,58 @@ int main(int argc, char** argv)
         //mem_arena_t* test_arena     = mem_arena_subarena(base_arena, 1); // should fail
     }
 
+    /* TEST NUMA ARENAS (single node machines just get one arena) */
+    {
+        assert(mem_numa_node_count() >= 1);
+        assert(mem_numa_node_online(mem_numa_current_node()));
+
+        mem_arena_numa_set_t set = mem_arena_numa_create(MEGABYTES(1));
+        mem_arena_t* local_arena = mem_arena_numa_local(&set);
+        assert(local_arena);
+        int is_in_set = 0;
+        for (int i = 0; i < set.count; i++) { if (set.arenas[i] == local_arena) { is_in_set = 1; } }
+        assert(is_in_set);
+
+        unsigned char* local_buf = (unsigned char*) mem_arena_push(local_arena, KILOBYTES(16));
+        for (size_t i = 0; i < KILOBYTES(16); i++) { assert(!local_buf[i]); }
+
+        mem_arena_t* interleaved_arena = mem_arena_create_on_node(MEGABYTES(1), MEM_NUMA_INTERLEAVE);
+        unsigned char* interleaved_buf = (unsigned char*) mem_arena_push(interleaved_arena, KILOBYTES(16));
+        for (size_t i = 0; i < KILOBYTES(16); i++) { assert(!interleaved_buf[i]); }
+
+        mem_arena_destroy(&interleaved_arena);
+        assert(!interleaved_arena);
+        mem_arena_numa_destroy(&set);
+        assert(!set.count);
+
+        /* binding & committing a plain reservation */
+        unsigned char* buf = (unsigned char*) mem_reserve_numa(NULL, KILOBYTES(64), MEM_NUMA_ANY);
+        assert(buf);
+        assert(mem_numa_bind(buf, KILOBYTES(64), MEM_NUMA_ANY));
+        assert(!mem_numa_bind(buf, KILOBYTES(64), mem_numa_node_count())); /* out of range */
+        assert(!mem_numa_bind(buf, KILOBYTES(64), -3));
+        int committed = mem_commit_numa(buf, KILOBYTES(4), mem_numa_current_node());
+        assert(committed);
+        for (size_t i = 0; i < KILOBYTES(4); i++) { assert(!buf[i]); }
+        mem_release(buf, KILOBYTES(64));
+
+        #if defined(__linux__) && defined(SYS_get_mempolicy)
+        /* the policy has to actually end up on the mapping, also on single node machines */
+        unsigned char* node_buf = (unsigned char*) mem_reserve_numa(NULL, KILOBYTES(64), 0);
+        assert(node_buf);
+        int           policy = -1;
+        unsigned long policy_nodes[MEM_NUMA_MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+        long got_policy = syscall(SYS_get_mempolicy, &policy, policy_nodes, MEM_NUMA_MAX_NODES + 1, node_buf, 2 /* MPOL_F_ADDR */);
+        if (got_policy == 0)
+        {
+            assert(policy == 1); /* MPOL_PREFERRED */
+            assert(policy_nodes[0] == 1);
+        }
+        else { assert(errno == EPERM || errno == ENOSYS); } /* e.g. seccomp in containers */
+        mem_release(node_buf, KILOBYTES(64));
+        #endif
+    }
+
     return 0;
 }
 